@@ -2,7 +2,12 @@
 #include <iostream>
 #include <cmath>
 #include <array>
+#include <vector>
 #include <sstream>
+#include "xoshiro.h"
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
 
 inline double w(double x)
 {
@@ -12,55 +17,116 @@ inline double w(double x)
   return exp(-x*x)/sqrt(M_PI); //gaussian
 }
 
-int main()
+// Sums n values over all processes onto rank 0 (MPI_Reduce, which MPI
+// implementations carry out as a tree). Nothing to do in a single process.
+void merge(double *data, int n)
 {
+#ifdef USE_MPI
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Reduce(rank == 0 ? MPI_IN_PLACE : data, data, n, MPI_DOUBLE, MPI_SUM,
+      0, MPI_COMM_WORLD);
+#endif
+}
+
+// usage: metropolisEquilibrium [seed]
+// Built with USE_MPI the walkers are shared out between the processes and
+// every snapshot of the histogram is merged onto rank 0.
+int main(int argc, char **argv)
+{
+  int rank = 0, size = 1;
+#ifdef USE_MPI
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+#endif
   std::random_device rd;
-  std::mt19937 rng(rd());
-  std::uniform_real_distribution<> uniform(0.0, 1.);
+  unsigned seed = argc > 1 ? strtoul(argv[1], NULL, 10) : rd();
+#ifdef USE_MPI
+  MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+#endif
 
   const int M = 50; //Partition of region of intergration
   const int walkers = M+1; //Number of walkers
   const double x2 = 3;
   const double x1 = -3;
   const double deltaM = (x2-x1)/M;
+  // this process runs walkers [first,last).
+  const int first = walkers*rank/size;
+  const int last = walkers*(rank+1)/size;
 
-  const int N = 3; // Number of different walks
-  std::array<int,N> stepsArray = {1, 500,1000};
-  std::array<std::vector<double>,N> X;
-  for (int i = 0; i < stepsArray.size(); ++i)
+  // snapshots of the running walks at logarithmically spaced walk sizes.
+  const int maxSteps = 1000; // longest walk
+  const int N = 13; // Number of snapshots
+  std::array<int,N> stepsArray;
+  for (int i = 0; i < N; ++i)
+    stepsArray[i] = (int) round(pow(maxSteps, (double) i/(N-1)));
+
+  // one walk per walker, every walker drawing from its own stream so it does
+  // not depend on which process runs it. Accepted points go straight into a
+  // running histogram, and a snapshot copies it: each snapshot costs only the
+  // steps since the one before.
+  std::vector<double> X;
+  std::vector<uniforms> uniform;
+  std::array<double,M> running = {};
+  double runningPoints = 0;
+  for (int walker = first; walker < last; ++walker)
   {
-    for (int walker = 0; walker < walkers; ++walker)
-    {
-      X[i].push_back(x1 + deltaM*walker);
-      for (int s = 1; s < stepsArray[i]; ++s)
-      {
-        double Xn = X[i].back();
-        double Xt = Xn + deltaM*(2*uniform(rng) - 1);
-        if (w(Xt)/w(Xn) > uniform(rng) &&  x1 <= Xt && Xt <= x2)
-          X[i].push_back(Xt);
-      }
-    }
+    X.push_back(x1 + deltaM*walker);
+    uniform.push_back(uniforms(seed, walker));
+    int k = (int) ceil((X.back() - x1)/deltaM) - 1;
+    if (0 <= k && k < M)
+      ++running[k];
+    ++runningPoints;
   }
 
-  std::array<std::array<double,M>,N> histogram = {};
-  for (int i = 0; i < X.size(); ++i)
+  std::array<std::array<double,M>,N> histogram;
+  std::array<double,N> totalPoints;
+  for (int i = 0; i < N; ++i)
   {
-    for (int j = 0; j < X[i].size(); ++j)
+    const int from = i == 0 ? 1 : stepsArray[i-1];
+    for (int j = 0; j < X.size(); ++j)
     {
-      for (int k = 0; k < histogram[i].size(); ++k)
+      for (int s = from; s < stepsArray[i]; ++s)
       {
-        if (x1 + deltaM*k < X[i][j] && X[i][j] <= x1 + deltaM*(k+1))
-          ++histogram[i][k];
+        double Xt = X[j] + deltaM*(2*uniform[j]() - 1);
+        if (w(Xt)/w(X[j]) > uniform[j]() &&  x1 <= Xt && Xt <= x2)
+        {
+          X[j] = Xt;
+          int k = (int) ceil((Xt - x1)/deltaM) - 1;
+          if (0 <= k && k < M)
+            ++running[k];
+          ++runningPoints;
+        }
       }
     }
+    histogram[i] = running;
+    totalPoints[i] = runningPoints;
+    merge(histogram[i].data(), M);
   }
+  merge(totalPoints.data(), N);
+#ifdef USE_MPI
+  MPI_Finalize();
+#endif
+  if (rank != 0)
+    return 0;
 
-    //CDF: discrete cumulative distribution function.
+    //CDF: discrete cumulative distribution function, and its KS distance
+    //to the target restricted to [x1,x2].
   std::array<std::array<double,M+1>,N> CDF = {};
-  for (int i = 0; i < X.size(); ++i)
+  std::array<double,N> D = {};
+  const double norm = erf(x2) - erf(x1);
+  printf("walk size  samples    KS distance\n");
+  for (int i = 0; i < N; ++i)
   {
     for (int j = 1; j < CDF[i].size(); ++j)
-      CDF[i][j] = CDF[i][j-1] + histogram[i][j-1]/X[i].size();
+    {
+      CDF[i][j] = CDF[i][j-1] + histogram[i][j-1]/totalPoints[i];
+      double x = x1 + deltaM*j;
+      // D[i] = std::max(D[i], fabs(CDF[i][j] - (-sin(4*x) + 2*sin(2*x) + 8*x)/(8*M_PI))); //sum of cos and sin
+      D[i] = std::max(D[i], fabs(CDF[i][j] - (erf(x) - erf(x1))/norm)); //gaussian
+    }
+    printf("%9i  %9.0f  %f\n", stepsArray[i], totalPoints[i], D[i]);
   }
 
   ///////////// gnuplot's commands ////////////////////////////////
@@ -68,7 +134,7 @@ int main()
   str_gp << "set terminal epslatex standalone\n";
   str_gp << "set output 'thisWillBeErased.tex'\n";
   str_gp << "set grid x y z back\n";
-  str_gp << "set ytics (1000,15000,30000,60000)\n";
+  str_gp << "set logscale y\n";
   str_gp << "set xyplane .1\n";
   str_gp << "set ylabel 'walk size' rotate parallel\n";
   str_gp << "set colorsequence podo\n";
@@ -89,8 +155,8 @@ int main()
   for (int i = 0; i < N; ++i)
   {
     for (int k = 0; k < histogram[i].size(); ++k)
-      fprintf(gp, "%f %i %f\n", deltaM*k+x1, stepsArray[i], histogram[i][k]/(X[i].size()*deltaM));
-    fprintf(gp, "%f %i %f\n\n\n", x2, stepsArray[i], histogram[i][M-1]/(X[i].size()*deltaM));
+      fprintf(gp, "%f %i %f\n", deltaM*k+x1, stepsArray[i], histogram[i][k]/(totalPoints[i]*deltaM));
+    fprintf(gp, "%f %i %f\n\n\n", x2, stepsArray[i], histogram[i][M-1]/(totalPoints[i]*deltaM));
   }
   fprintf(gp, "e\n");
   for (int i = 1; i < N; ++i)
@@ -2,7 +2,13 @@
 #include <iostream>
 #include <cmath>
 #include <array>
+#include <vector>
 #include <sstream>
+#include "xoshiro.h"
+#include "sampleStore.h"
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
 
 inline double w(double x)
 {
@@ -11,46 +17,251 @@ inline double w(double x)
   return 1./M_PI * (sin(2*x)*sin(2*x) + cos(x)*cos(x));
   // return exp(-x*x)/sqrt(M_PI); //gaussian
 }
+// id saved with the samples: 0 for sin^2(2x)+cos^2(x), 1 for the gaussian.
+const uint32_t DENSITY = 0;
 
-int main()
+typedef int32_t intLanes __attribute__((vector_size(64)));
+#pragma GCC diagnostic ignored "-Wpsabi" // as in xoshiro.h, lanes stay inline
+
+// cos(x) for |x| < 2^20 on sixteen floats at once.
+// x = k*pi + r, |r| <= pi/2, cos(x) = (-1)^k cos(r); error below 1e-7.
+inline floatLanes cosLane(const floatLanes &x)
 {
-  std::random_device rd;
-  std::mt19937 rng(rd());
-  std::uniform_real_distribution<> uniform(0.0, 1.);
+  const float pi_hi = 3.140625f, pi_lo = 9.67653589793e-4f;
+  const float round = 12582912.f; // 1.5*2^23: adding it rounds to an integer
+  floatLanes k = (x * (float) M_1_PI + round) - round;
+  floatLanes r = (x - k*pi_hi) - k*pi_lo;
+  floatLanes r2 = r*r;
+  floatLanes c = 1.f/479001600 * r2 - 1.f/3628800;
+  c = c*r2 + 1.f/40320;
+  c = c*r2 - 1.f/720;
+  c = c*r2 + 1.f/24;
+  c = c*r2 - 1.f/2;
+  c = c*r2 + 1.f;
+  return (__builtin_convertvector(k, intLanes) & 1) ? -c : c;
+}
 
-  const int M = 100; //Partition of region of intergration
-  const int walkers = M+1; //Number of walkers
-  const double x2 = M_PI;
-  const double x1 = 0;
-  const double deltaM = (x2-x1)/M;
-  const int steps = 30000;
+// float twin of w for the single precision sampler.
+inline floatLanes wLane(const floatLanes &x)
+{
+  // sin^2(2x) + cos^2(x) = 1 + (cos(2x) - cos(4x))/2
+  return (float) M_1_PI * (1.f + .5f*(cosLane(2.f*x) - cosLane(4.f*x)));
+  // floatLanes g; //gaussian, lane by lane
+  // for (int l = 0; l < 16; ++l)
+  //   g[l] = expf(-x[l]*x[l])/sqrtf(M_PI);
+  // return g;
+}
 
-  std::vector<double> X;
-  for (int walker = 0; walker <= walkers; ++walker)
+// Random walks of walkers [first,last), each starting deltaM*walker above x1;
+// X gets every accepted point. Every walker draws from its own stream, so a
+// walk does not depend on which process runs it or on what ran before it.
+// Each walk is also appended to sink, if given.
+void metropolis(unsigned seed, double x1, double x2, double deltaM,
+    int first, int last, int steps, std::vector<double> &X,
+    sampleSink *sink = NULL)
+{
+  for (int walker = first; walker < last; ++walker)
   {
+    uniforms uniform(seed, walker);
+    const size_t start = X.size();
     X.push_back(x1 + deltaM*walker);
     for (int s = 0; s < steps; ++s)
     {
       double Xn = X.back();
-      double Xt = Xn + deltaM*(2*uniform(rng) - 1);
-      if (w(Xt)/w(Xn) > uniform(rng) &&  x1 <= Xt && Xt <= x2)
+      double Xt = Xn + deltaM*(2*uniform() - 1);
+      if (w(Xt)/w(Xn) > uniform() &&  x1 <= Xt && Xt <= x2)
         X.push_back(Xt);
     }
+    if (sink)
+      sink->append(walker, steps, &X[start], X.size() - start);
   }
+}
 
-  std::array <double,M> histogram = {};
+// Same walks in float, LANES walkers at a time, written with vector types:
+// proposals, densities and acceptance are vector operations over the lanes,
+// with each walker drawing the numbers of its uniforms stream. Only binning
+// is a scalar loop, it scatters into the histogram, which like the returned
+// total is kept in double.
+const int LANES = uniformLanes::LANES;
+double metropolisLanes(unsigned seed, float x1, float x2, float deltaM,
+    int first, int last, int steps, double *histogram, int M)
+{
+  double totalPoints = 0;
+  for (int group = first; group < last; group += LANES)
+  {
+    // lanes past the last walker repeat it and are never binned.
+    uniformLanes uniform(seed, group);
+    floatLanes x;
+    intLanes live;
+    for (int l = 0; l < LANES; ++l)
+    {
+      x[l] = x1 + deltaM*std::min(group + l, last - 1);
+      live[l] = group + l < last ? -1 : 0;
+    }
+    floatLanes wx = wLane(x);
+    intLanes accepted = live; // the starting point is a sample
+    for (int s = 0; s <= steps; ++s)
+    {
+      // bin k = ceil(t) - 1: truncation, less one where t is whole.
+      floatLanes t = (x - x1)/deltaM;
+      intLanes k = __builtin_convertvector(t, intLanes);
+      k += __builtin_convertvector(k, floatLanes) == t;
+      for (int l = 0; l < LANES; ++l)
+      {
+        if (!accepted[l])
+          continue;
+        if (0 <= k[l] && k[l] < M)
+          ++histogram[k[l]];
+        ++totalPoints;
+      }
+      if (s == steps)
+        break;
+      floatLanes u = uniform();
+      floatLanes v = uniform();
+      floatLanes xt = x + deltaM*(2.f*u - 1.f);
+      floatLanes wt = wLane(xt);
+      intLanes accept = (wt > v*wx) & (x1 <= xt) & (xt <= x2);
+      x = accept ? xt : x;
+      wx = accept ? wt : wx;
+      accepted = accept & live;
+    }
+  }
+  return totalPoints;
+}
+
+// Kolmogorov-Smirnov distance between two samples binned alike.
+double ksDistance(const double *histogramA, double totalA,
+    const double *histogramB, double totalB, int M)
+{
+  double D = 0, CDF_A = 0, CDF_B = 0;
+  for (int k = 0; k < M; ++k)
+  {
+    CDF_A += histogramA[k]/totalA;
+    CDF_B += histogramB[k]/totalB;
+    D = std::max(D, fabs(CDF_A - CDF_B));
+  }
+  return D;
+}
+
+void histogramOf(const std::vector<double> &X, double x1, double deltaM,
+    double *histogram, int M)
+{
   for (int i = 0; i < X.size(); ++i)
   {
-    for (int j = 0; j < histogram.size(); ++j)
+    for (int j = 0; j < M; ++j)
     {
       if (x1 + deltaM*j < X[i] && X[i] <= x1 + deltaM*(j+1))
         ++histogram[j];
     }
   }
+}
+
+// Sums n values over all processes onto rank 0 (MPI_Reduce, which MPI
+// implementations carry out as a tree). Nothing to do in a single process.
+void merge(double *data, int n)
+{
+#ifdef USE_MPI
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Reduce(rank == 0 ? MPI_IN_PLACE : data, data, n, MPI_DOUBLE, MPI_SUM,
+      0, MPI_COMM_WORLD);
+#endif
+}
+
+// usage: metropolisMethod [seed [samples]]
+// With a samples path the walks of the double sampler are saved there for
+// rebinSamples; the float sampler saves nothing. Built with USE_MPI the
+// walkers are shared out between the processes, each saving to
+// samples.<rank>; histograms are integer counts, so any process count gives
+// the same result for the same seed.
+int main(int argc, char **argv)
+{
+  int rank = 0, size = 1;
+#ifdef USE_MPI
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+#endif
+  std::random_device rd;
+  unsigned seed = argc > 1 ? strtoul(argv[1], NULL, 10) : rd();
+#ifdef USE_MPI
+  MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+#endif
+
+  const int M = 100; //Partition of region of intergration
+  const int walkers = M+1; //Number of walkers
+  const double x2 = M_PI;
+  const double x1 = 0;
+  const double deltaM = (x2-x1)/M;
+  const int steps = 30000;
+  // opt-in float sampler; positions only need to resolve a bin of deltaM.
+  const bool singlePrecision = false;
+  // with singlePrecision, also run the double sampler (twice) and compare
+  // the histograms with a KS statistic; costs far more than the float lanes.
+  const bool validate = false;
+  // this process runs walkers [first,last) of 0..walkers.
+  const int first = (walkers+1)*rank/size;
+  const int last = (walkers+1)*(rank+1)/size;
+
+  std::array <double,M> histogram = {};
+  double totalPoints;
+  if (singlePrecision)
+  {
+    totalPoints = metropolisLanes(seed, x1, x2, deltaM, first, last, steps, histogram.data(), M);
+    merge(histogram.data(), M);
+    merge(&totalPoints, 1);
+  }
+  if (!singlePrecision || validate)
+  {
+    std::vector<double> X;
+    sampleSink *sink = NULL;
+    if (argc > 2 && !singlePrecision) // only the walks that are plotted
+    {
+      std::string path = argv[2];
+      if (size > 1)
+        path += "." + std::to_string(rank);
+      sink = new sampleSink(path.c_str(), DENSITY, seed, x1, x2);
+    }
+    metropolis(seed, x1, x2, deltaM, first, last, steps, X, sink);
+    delete sink;
+    std::array <double,M> histogramX = {};
+    histogramOf(X, x1, deltaM, histogramX.data(), M);
+    double totalX = X.size();
+    merge(histogramX.data(), M);
+    merge(&totalX, 1);
+    if (!singlePrecision)
+    {
+      histogram = histogramX;
+      totalPoints = totalX;
+    }
+    else
+    {
+      // the walks are correlated, so the iid critical value of D means
+      // little; a second double run gives the distance to expect instead.
+      std::vector<double> Y;
+      metropolis(seed+1, x1, x2, deltaM, first, last, steps, Y);
+      std::array <double,M> histogramY = {};
+      histogramOf(Y, x1, deltaM, histogramY.data(), M);
+      double totalY = Y.size();
+      merge(histogramY.data(), M);
+      merge(&totalY, 1);
+      if (rank == 0)
+        printf("KS distance float/double: %g, double/double: %g\n",
+            ksDistance(histogram.data(), totalPoints, histogramX.data(), totalX, M),
+            ksDistance(histogramY.data(), totalY, histogramX.data(), totalX, M));
+    }
+  }
+#ifdef USE_MPI
+  MPI_Finalize();
+#endif
+  if (rank != 0)
+    return 0;
+  const int proposals = (walkers+1)*steps;
+  printf("seed %u: %.0f samples, acceptance %f\n", seed, totalPoints,
+      (totalPoints - (walkers+1))/proposals);
 
     //CDF: discrete cumulative distribution function.
   std::array <double,M+1> CDF = {};
-  const int totalPoints = X.size();
   for (int i = 1; i < CDF.size(); ++i)
     CDF[i] = CDF[i-1] + histogram[i-1]/totalPoints;
 
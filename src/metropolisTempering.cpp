@@ -0,0 +1,252 @@
+#include <random>
+#include <iostream>
+#include <cmath>
+#include <array>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include "xoshiro.h"
+
+inline double w(double x)
+{
+  //Normalized in the range [0,pi]
+
+  return 1./M_PI * (sin(2*x)*sin(2*x) + cos(x)*cos(x));
+  // return exp(-x*x)/sqrt(M_PI); //gaussian
+}
+
+// One tempered copy of the walk, sampling w(x)^beta.
+typedef struct replica
+{
+  double beta, x, logw;
+  uniforms uniform;
+} replica;
+
+// steps of metropolis on w^beta; the proposal width grows as 1/beta so the
+// hot copies cross the whole range. Visits of the beta = 1 copy are binned.
+void walk(replica &r, double x1, double x2, double deltaM, int steps,
+    double *histogram, int M, double &totalPoints)
+{
+  const double width = std::min(deltaM/r.beta, x2-x1);
+  for (int s = 0; s < steps; ++s)
+  {
+    double Xt = r.x + width*(2*r.uniform() - 1);
+    if (x1 <= Xt && Xt <= x2)
+    {
+      double logwt = log(w(Xt));
+      if (r.beta*(logwt - r.logw) > log(r.uniform()))
+      {
+        r.x = Xt;
+        r.logw = logwt;
+      }
+    }
+    if (histogram)
+    {
+      int k = (int) ceil((r.x - x1)/deltaM) - 1;
+      if (0 <= k && k < M)
+        ++histogram[k];
+      ++totalPoints;
+    }
+  }
+}
+
+// Blocks until count threads have called wait(); the last one to arrive
+// runs done() before all of them are released. Waiting threads spin on the
+// generation and yield, which is far cheaper than sleeping on a condition
+// variable for the short rounds between exchanges.
+class barrier
+{
+public:
+  barrier(int count) : count(count), waiting(0), generation(0) {}
+  template <class F>
+  void wait(F done)
+  {
+    int g = generation.load(std::memory_order_acquire);
+    if (waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == count)
+    {
+      done();
+      waiting.store(0, std::memory_order_relaxed);
+      generation.store(g + 1, std::memory_order_release);
+    }
+    else
+      while (generation.load(std::memory_order_acquire) == g)
+        std::this_thread::yield();
+  }
+private:
+  int count;
+  std::atomic<int> waiting, generation;
+};
+
+int main()
+{
+  std::random_device rd;
+  uniforms uniform(rd());
+
+  const int M = 100; //Partition of region of intergration
+  const double x2 = M_PI;
+  const double x1 = 0;
+  const double deltaM = (x2-x1)/M;
+
+  const int R = 8; // replicas, one thread each
+  const double betaMin = .05; // hottest copy
+  const int swapInterval = 200; // steps between exchange attempts
+  const int burnIn = 1000; // exchange rounds spent adapting the ladder
+  const int adaptEvery = 25; // rounds between ladder updates
+  const int rounds = 5000; // exchange rounds sampled after burn-in
+
+  // start from a geometric ladder, beta_0 = 1 (the target) down to betaMin.
+  std::array<replica,R> replicas;
+  for (int i = 0; i < R; ++i)
+  {
+    replicas[i].beta = pow(betaMin, (double) i/(R-1));
+    replicas[i].x = x1 + (x2-x1)*uniform();
+    replicas[i].logw = log(w(replicas[i].x));
+    replicas[i].uniform = uniforms(rd());
+  }
+
+  // round trips: a configuration is labelled by the end of the ladder it
+  // last touched and counts a trip when it comes back to beta = 1 from betaMin.
+  std::array<int,R> label, lastEnd;
+  for (int i = 0; i < R; ++i)
+  {
+    label[i] = i;
+    lastEnd[i] = i == 0 ? 0 : -1;
+  }
+  int roundTrips = 0;
+
+  std::array<double,R-1> tried = {}, swapped = {};
+  std::array<double,M> histogram = {};
+  double totalPoints = 0;
+
+  // after every round of walks the last replica thread to reach the barrier
+  // does the exchanges, so each round costs one synchronization.
+  auto exchange = [&](int round)
+  {
+    const bool sampling = round >= burnIn;
+    // exchange neighbours, even pairs on even rounds and odd pairs on odd ones.
+    for (int i = round % 2; i < R-1; i += 2)
+    {
+      replica &a = replicas[i], &b = replicas[i+1];
+      ++tried[i];
+      if ((a.beta - b.beta)*(b.logw - a.logw) > log(uniform()))
+      {
+        std::swap(a.x, b.x);
+        std::swap(a.logw, b.logw);
+        std::swap(label[i], label[i+1]);
+        ++swapped[i];
+      }
+    }
+    if (lastEnd[label[0]] == R-1)
+      ++roundTrips;
+    lastEnd[label[0]] = 0;
+    lastEnd[label[R-1]] = R-1;
+
+    // rescale the gaps in log(beta) so every pair swaps at the same rate:
+    // gaps of pairs that swap often widen, the others narrow.
+    if (!sampling && (round+1) % adaptEvery == 0)
+    {
+      double mean = 0;
+      for (int i = 0; i < R-1; ++i)
+        mean += swapped[i]/tried[i]/(R-1);
+      std::array<double,R-1> gap;
+      double total = 0;
+      for (int i = 0; i < R-1; ++i)
+      {
+        gap[i] = log(replicas[i].beta/replicas[i+1].beta)
+          * exp(swapped[i]/tried[i] - mean);
+        total += gap[i];
+      }
+      for (int i = 1; i < R; ++i)
+        replicas[i].beta = replicas[i-1].beta * exp(-gap[i-1]*log(1/betaMin)/total);
+      tried = {};
+      swapped = {};
+    }
+    if (round+1 == burnIn)
+      roundTrips = 0;
+  };
+  barrier sync(R);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < R; ++i)
+    threads.push_back(std::thread([&, i]()
+    {
+      for (int round = 0; round < burnIn + rounds; ++round)
+      {
+        walk(replicas[i], x1, x2, deltaM, swapInterval,
+            (round >= burnIn && i == 0) ? histogram.data() : nullptr, M, totalPoints);
+        sync.wait([&]{ exchange(round); });
+      }
+    }));
+  for (int i = 0; i < R; ++i)
+    threads[i].join();
+
+  printf("beta      swap rate with next\n");
+  for (int i = 0; i < R; ++i)
+  {
+    if (i < R-1)
+      printf("%f  %f\n", replicas[i].beta, swapped[i]/tried[i]);
+    else
+      printf("%f\n", replicas[i].beta);
+  }
+  printf("round trips: %i\n", roundTrips);
+
+    //CDF: discrete cumulative distribution function.
+  std::array <double,M+1> CDF = {};
+  double D = 0;
+  for (int i = 1; i < CDF.size(); ++i)
+  {
+    CDF[i] = CDF[i-1] + histogram[i-1]/totalPoints;
+    double x = x1 + deltaM*i;
+    D = std::max(D, fabs(CDF[i] - (-sin(4*x) + 2*sin(2*x) + 8*x)/(8*M_PI))); //sum of cos and sin
+    // D = std::max(D, fabs(CDF[i] - .5*(erf(x) + 1))); //gaussian
+  }
+  printf("KS distance to w: %g\n", D);
+
+  ///////////// gnuplot's commands ////////////////////////////////
+  std::ostringstream str_gp;
+  str_gp << "set terminal epslatex standalone\n";
+  str_gp << "set output 'thisWillBeErased.tex'\n";
+  str_gp << "set colorsequence podo\n";
+  str_gp << "set label '"<<R<<" replicas' at "<<.7*(x2-x1)+x1<<",.8\n";
+  str_gp << "set label '"<<rounds*swapInterval<<" steps' at "<<.7*(x2-x1)+x1<<",.74\n";
+  str_gp << "set border lw 3\n";
+  str_gp << "set key top left spacing 1.3\n";
+  str_gp << "set xrange ["<<x1<<":"<<x2<<"]\n";
+  str_gp << "set sample 300\n";
+  str_gp << "plot ";
+  //////////////////////////////////////////////////////////////////
+
+  /////////////// plot ////////////////////////////////////////////////
+  FILE *gp = popen("gnuplot","w");
+
+  str_gp << "(sin(2*x)**2 + cos(x)**2)/pi w l lw 3 t '$w(x)$',"; //sum of cos and sin
+  str_gp << "(-sin(4*x) +2*sin(2*x) +8*x)/(8*pi) w l lw 3 t '$\\int w(x)$',"; //sum of cos and sin CDF
+  // str_gp << "exp(-x**2)/sqrt(pi) w l lw 3 t '$w(x)$',"; //gaussian
+  // str_gp << ".5*(erf(x)+1) lw 2 t '$\\int w(x)$',"; //gaussian CDF
+  str_gp << "'-' w boxes lw 3 t 'histogram',";
+  str_gp << "'-' w steps lw 3 t 'cdf'\n";
+
+  fprintf(gp, "%s", str_gp.str().c_str());//this sends all commands
+
+  //this sends the points for command '-'
+  for (int k = 0; k < histogram.size(); ++k)
+    fprintf(gp, "%f %f\n", deltaM*k+x1, histogram[k]/(totalPoints*deltaM));
+  fprintf(gp, "%f %f\n", x2, histogram[M-1]/(totalPoints*deltaM));
+  fprintf(gp, "e\n");
+
+  for (int k = 0; k < CDF.size(); ++k)
+    fprintf(gp, "%f %f\n", deltaM*k+x1, CDF[k]);
+  fprintf(gp, "e\n");
+
+  pclose(gp);
+  //////////////////////////////////////////////////////////////////
+
+  //////////// tex2pdf and output cleanup ////////////////////////////
+  std::string str_sys = "";
+  str_sys += "latex -interaction batchmode thisWillBeErased.tex\n";
+  str_sys += "dvipdf thisWillBeErased.dvi output.pdf\n";
+  str_sys += "rm -f thisWillBeErased*\n";
+  system(str_sys.c_str());
+  ///////////////////////////////////////////////////////////////////
+  return 0;
+}
@@ -0,0 +1,189 @@
+#ifndef POTENTIALS_H
+#define POTENTIALS_H
+
+#include <cmath>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Dimensionless potentials and their batch kernels.
+// The batch versions evaluate V(x) or the local momentum sqrt(E - V(x))
+// on an array of n points; with AVX2 four points go per instruction,
+// otherwise the scalar functions below are used point by point.
+
+
+// Lennard-Jones: 4(x^-12 - x^-6), built from x^-2 instead of pow.
+inline double lennardJones(double x)
+{
+  double s2 = 1./(x*x);
+  double s6 = s2*s2*s2;
+  return 4*s6*(s6 - 1);
+}
+
+// Morse: V0((1 - exp((r_min - r)/beta))^2 - 1).
+inline double morse(double r, double beta, double r_min, double V0)
+{
+  double f = 1 - exp((r_min - r)/beta);
+  return V0 * (f*f - 1);
+}
+
+// quantum harmonic oscillator: x^2/2.
+inline double qho(double x)
+{
+  return .5*x*x;
+}
+
+// derivatives dV/dx and d2V/dx2, used for the slopes and curvatures at the
+// turning points.
+inline double lennardJonesPrime(double x)
+{
+  double s2 = 1./(x*x);
+  double s6 = s2*s2*s2;
+  return 24*s6*(1 - 2*s6)/x;
+}
+
+inline double morsePrime(double r, double beta, double r_min, double V0)
+{
+  double e = exp((r_min - r)/beta);
+  return 2*V0*(1 - e)*e/beta;
+}
+
+inline double lennardJonesPrime2(double x)
+{
+  double s2 = 1./(x*x);
+  double s6 = s2*s2*s2;
+  return 24*s6*s2*(26*s6 - 7);
+}
+
+inline double morsePrime2(double r, double beta, double r_min, double V0)
+{
+  double e = exp((r_min - r)/beta);
+  return 2*V0*(2*e - 1)*e/(beta*beta);
+}
+
+
+#ifdef __AVX2__
+inline __m256d lennardJones(__m256d x)
+{
+  const __m256d one = _mm256_set1_pd(1.), four = _mm256_set1_pd(4.);
+  __m256d s2 = _mm256_div_pd(one, _mm256_mul_pd(x, x));
+  __m256d s6 = _mm256_mul_pd(_mm256_mul_pd(s2, s2), s2);
+  return _mm256_mul_pd(_mm256_mul_pd(four, s6), _mm256_sub_pd(s6, one));
+}
+
+// exp(x) = 2^k exp(r), |r| <= ln2/2, exp(r) by a degree 12 Taylor polynomial.
+// Agrees with std::exp to a few ulp for |x| < 700.
+inline __m256d exp(__m256d x)
+{
+  const __m256d log2e = _mm256_set1_pd(1.4426950408889634);
+  const __m256d ln2_hi = _mm256_set1_pd(6.93145751953125e-1);
+  const __m256d ln2_lo = _mm256_set1_pd(1.42860682030941723212e-6);
+  x = _mm256_max_pd(_mm256_min_pd(x, _mm256_set1_pd(700.)), _mm256_set1_pd(-700.));
+  __m256d k = _mm256_round_pd(_mm256_mul_pd(x, log2e),
+      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256d r = _mm256_sub_pd(_mm256_sub_pd(x, _mm256_mul_pd(k, ln2_hi)),
+      _mm256_mul_pd(k, ln2_lo));
+  __m256d y = _mm256_set1_pd(1./479001600);
+  const double c[12] = {1./39916800, 1./3628800, 1./362880, 1./40320, 1./5040,
+    1./720, 1./120, 1./24, 1./6, 1./2, 1., 1.};
+  for (int i = 0; i < 12; ++i)
+    y = _mm256_add_pd(_mm256_mul_pd(y, r), _mm256_set1_pd(c[i]));
+  __m256i e = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(k));
+  e = _mm256_slli_epi64(_mm256_add_epi64(e, _mm256_set1_epi64x(1023)), 52);
+  return _mm256_mul_pd(y, _mm256_castsi256_pd(e));
+}
+
+inline __m256d morse(__m256d r, double beta, double r_min, double V0)
+{
+  const __m256d one = _mm256_set1_pd(1.);
+  __m256d a = _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(r_min), r),
+      _mm256_set1_pd(1./beta));
+  __m256d f = _mm256_sub_pd(one, exp(a));
+  return _mm256_mul_pd(_mm256_set1_pd(V0),
+      _mm256_sub_pd(_mm256_mul_pd(f, f), one));
+}
+
+inline __m256d qho(__m256d x)
+{
+  return _mm256_mul_pd(_mm256_set1_pd(.5), _mm256_mul_pd(x, x));
+}
+#endif
+
+
+// v[i] = V(x[i])
+inline void lennardJones(const double *x, double *v, int n)
+{
+  int i = 0;
+#ifdef __AVX2__
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(v + i, lennardJones(_mm256_loadu_pd(x + i)));
+#endif
+  for (; i < n; ++i)
+    v[i] = lennardJones(x[i]);
+}
+
+// p[i] = sqrt(e - V(x[i]))
+inline void lennardJonesMomentum(double e, const double *x, double *p, int n)
+{
+  int i = 0;
+#ifdef __AVX2__
+  const __m256d E = _mm256_set1_pd(e);
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(p + i, _mm256_sqrt_pd(
+          _mm256_sub_pd(E, lennardJones(_mm256_loadu_pd(x + i)))));
+#endif
+  for (; i < n; ++i)
+    p[i] = sqrt(e - lennardJones(x[i]));
+}
+
+inline void morse(const double *r, double *v, int n,
+    double beta, double r_min, double V0)
+{
+  int i = 0;
+#ifdef __AVX2__
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(v + i, morse(_mm256_loadu_pd(r + i), beta, r_min, V0));
+#endif
+  for (; i < n; ++i)
+    v[i] = morse(r[i], beta, r_min, V0);
+}
+
+inline void morseMomentum(double E, const double *r, double *p, int n,
+    double beta, double r_min, double V0)
+{
+  int i = 0;
+#ifdef __AVX2__
+  const __m256d e = _mm256_set1_pd(E);
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(p + i, _mm256_sqrt_pd(
+          _mm256_sub_pd(e, morse(_mm256_loadu_pd(r + i), beta, r_min, V0))));
+#endif
+  for (; i < n; ++i)
+    p[i] = sqrt(E - morse(r[i], beta, r_min, V0));
+}
+
+inline void qho(const double *x, double *v, int n)
+{
+  int i = 0;
+#ifdef __AVX2__
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(v + i, qho(_mm256_loadu_pd(x + i)));
+#endif
+  for (; i < n; ++i)
+    v[i] = qho(x[i]);
+}
+
+inline void qhoMomentum(double e, const double *x, double *p, int n)
+{
+  int i = 0;
+#ifdef __AVX2__
+  const __m256d E = _mm256_set1_pd(e);
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(p + i, _mm256_sqrt_pd(
+          _mm256_sub_pd(E, qho(_mm256_loadu_pd(x + i)))));
+#endif
+  for (; i < n; ++i)
+    p[i] = sqrt(e - qho(x[i]));
+}
+
+#endif
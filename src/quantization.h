@@ -0,0 +1,85 @@
+#ifndef QUANTIZATION_H
+#define QUANTIZATION_H
+
+#include <cmath>
+#include <cfloat>
+
+// Bode's rule over N intervals of width h, with the singular endpoint left
+// out, underestimates int_0^{Nh} dt/sqrt(a t) by c*sqrt(h/a). Adding
+// c*(sqrt(h/a) + sqrt(h/b)) to the bode sum of a period integrand 1/sqrt(E-V),
+// with a and b the slopes |V'| at the two turning points, removes the
+// leading error of the classical period.
+inline double bodeSingularity(int N)
+{
+  double s = 7/sqrt(N);
+  for (int j = 1; j < N; ++j)
+    s += (j%2 ? 32 : j%4 ? 12 : 14)/sqrt(j);
+  return 2*sqrt(N) - 2*s/45;
+}
+
+// Next order: near a turning point 1/sqrt(E-V) = (a t)^-1/2 (1 + V'' t/(4a) + ...)
+// and bode underestimates int_0^{Nh} sqrt(t) dt by c2*h^(3/2). Adding also
+// c2*h^(3/2)*(V''(in)/(4 a^(3/2)) + V''(out)/(4 b^(3/2))) leaves an O(h^(5/2))
+// error in the period.
+inline double bodeSingularity2(int N)
+{
+  double s = 7*sqrt(N);
+  for (int j = 1; j < N; ++j)
+    s += (j%2 ? 32 : j%4 ? 12 : 14)*sqrt(j);
+  return 2*N*sqrt(N)/3 - 2*s/45;
+}
+
+// Guess for the level above E_n when S grows by dS_target per level.
+// dE/dS = 1/S' is extrapolated linearly from the level below (dS_m), which
+// tracks the shrinking spacing of anharmonic wells. dS_m = dS_n gives the
+// plain step dS_target/dS_n.
+inline double nextLevel(double E_n, double dS_n, double dS_m, double dS_target)
+{
+  return E_n + dS_target/dS_n + .5*dS_target*(1/dS_n - 1/dS_m);
+}
+
+// Solves S(E) = target for an action that increases monotonically on (lo,hi].
+// action(E, dS) returns S(E) and stores dS/dE, which for a WKB action is the
+// classical period. Newton steps are taken from guess (from near lo if guess
+// is NAN or outside the bracket); every evaluation shrinks the bracket, and a
+// step that would leave it is replaced by bisection, or by a single probe at
+// hi while no S(E) >= target has been seen.
+// Returns NAN if S never reaches target in (lo,hi]. On success *dS_root, if
+// given, holds dS/dE at the root for extrapolating the next level.
+template <class Action>
+double quantize(Action action, double target, double lo, double hi,
+    double guess = NAN, double *dS_root = 0)
+{
+  double E = (guess > lo && guess < hi) ? guess : lo + 1e-3*(hi - lo);
+  bool bracketed = false; // true once some S(E) >= target
+  for (int iter = 0; iter < 100; ++iter)
+  {
+    double dS;
+    double f = action(E, dS) - target;
+    if (dS_root)
+      *dS_root = dS;
+    if (fabs(f) <= 2*DBL_EPSILON*fabs(target))
+      return E;
+    if (f < 0 && E == hi)
+      return NAN;
+    if (f > 0)
+    {
+      hi = E;
+      bracketed = true;
+    }
+    else
+      lo = E;
+
+    double next = E - f/dS;
+    if (!bracketed && !(next < hi))
+      next = hi;
+    else if (!(next > lo && next < hi)) // also catches dS = 0 or NAN
+      next = .5*(lo + hi);
+    if (fabs(next - E) <= 2*DBL_EPSILON*fabs(E) || hi - lo <= 2*DBL_EPSILON*fabs(E))
+      return next;
+    E = next;
+  }
+  return bracketed ? E : NAN;
+}
+
+#endif
@@ -0,0 +1,186 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <sstream>
+#include "sampleStore.h"
+
+// Analytic CDFs of the densities a sample file can name, for the KS distance.
+double cdf(uint32_t density, double x)
+{
+  if (density == 0)
+    return (-sin(4*x) + 2*sin(2*x) + 8*x)/(8*M_PI); //sum of cos and sin
+  return .5*(erf(x) + 1); //gaussian
+}
+
+// usage: rebinSamples [-M bins] [-r x1 x2] samples...
+// Histogram, CDF and chain diagnostics straight from the mapped sample
+// files written by metropolisMethod, e.g. with another bin count or range.
+int main(int argc, char **argv)
+{
+  int M = 100;
+  double x1 = NAN, x2 = NAN;
+  std::vector<std::string> paths;
+  for (int a = 1; a < argc; ++a)
+  {
+    std::string arg = argv[a];
+    if (arg == "-M" && a+1 < argc)
+      M = atoi(argv[++a]);
+    else if (arg == "-r" && a+2 < argc)
+    {
+      x1 = atof(argv[++a]);
+      x2 = atof(argv[++a]);
+    }
+    else
+      paths.push_back(arg);
+  }
+  if (paths.empty() || M < 1)
+  {
+    fprintf(stderr, "usage: %s [-M bins] [-r x1 x2] samples...\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<sampleStore *> stores;
+  for (int f = 0; f < paths.size(); ++f)
+    stores.push_back(new sampleStore(paths[f].c_str()));
+  const sampleHeader &header = stores[0]->header;
+  // runs with other seeds may be pooled, other densities or ranges may not.
+  for (int f = 1; f < stores.size(); ++f)
+  {
+    const sampleHeader &h = stores[f]->header;
+    if (h.density != header.density || h.x1 != header.x1 || h.x2 != header.x2)
+    {
+      fprintf(stderr, "%s: density or range differs from %s\n",
+          paths[f].c_str(), paths[0].c_str());
+      exit(1);
+    }
+  }
+  if (std::isnan(x1))
+  {
+    x1 = header.x1;
+    x2 = header.x2;
+  }
+  const double deltaM = (x2-x1)/M;
+
+  std::vector<double> histogram(M, 0.);
+  double totalPoints = 0;
+  // Gelman-Rubin: within-chain variance against the spread of chain means.
+  double sumMean = 0, sumMean2 = 0, sumVar = 0, sumLength = 0;
+  int chains = 0;
+  for (int f = 0; f < stores.size(); ++f)
+  {
+    for (int c = 0; c < stores[f]->chains.size(); ++c)
+    {
+      const sampleStore::chain &chain = stores[f]->chains[c];
+      double mean = 0, m2 = 0;
+      for (uint64_t i = 0; i < chain.count; ++i)
+      {
+        const double x = chain.x[i];
+        int k = (int) ceil((x - x1)/deltaM) - 1;
+        if (0 <= k && k < M)
+          ++histogram[k];
+        // welford's running mean and variance.
+        double d = x - mean;
+        mean += d/(i+1);
+        m2 += d*(x - mean);
+      }
+      totalPoints += chain.count;
+      if (chain.count > 1)
+      {
+        sumMean += mean;
+        sumMean2 += mean*mean;
+        sumVar += m2/(chain.count - 1);
+        sumLength += chain.count;
+        ++chains;
+      }
+    }
+  }
+
+    //CDF: discrete cumulative distribution function.
+  std::vector<double> CDF(M+1, 0.);
+  double D = 0;
+  // the samples only cover [header.x1,header.x2]; the target CDF is
+  // renormalized to that range.
+  const double norm = cdf(header.density, header.x2) - cdf(header.density, header.x1);
+  for (int i = 1; i < CDF.size(); ++i)
+  {
+    CDF[i] = CDF[i-1] + histogram[i-1]/totalPoints;
+    D = std::max(D, fabs(CDF[i] - (cdf(header.density, x1 + deltaM*i)
+            - cdf(header.density, x1))/norm));
+  }
+
+  printf("%i files, %i chains, %.0f samples, seeds", (int) paths.size(),
+      chains, totalPoints);
+  for (int f = 0; f < stores.size(); ++f)
+  {
+    int g = 0;
+    while (stores[g]->header.seed != stores[f]->header.seed)
+      ++g;
+    if (g == f) // first file with this seed
+      printf(" %llu", (unsigned long long) stores[f]->header.seed);
+  }
+  printf("\n");
+  printf("KS distance to w on [%g,%g]: %g\n", x1, x2, D);
+  if (chains > 1)
+  {
+    double n = sumLength/chains;
+    double W = sumVar/chains;
+    double B = n*(sumMean2 - sumMean*sumMean/chains)/(chains - 1);
+    printf("Gelman-Rubin R: %f\n", sqrt(((n-1)/n*W + B/n)/W));
+  }
+
+  ///////////// gnuplot's commands ////////////////////////////////
+  std::ostringstream str_gp;
+  str_gp << "set terminal epslatex standalone\n";
+  str_gp << "set output 'thisWillBeErased.tex'\n";
+  str_gp << "set colorsequence podo\n";
+  str_gp << "set border lw 3\n";
+  str_gp << "set key top left spacing 1.3\n";
+  str_gp << "set xrange ["<<x1<<":"<<x2<<"]\n";
+  str_gp << "set sample 300\n";
+  str_gp << "plot ";
+  //////////////////////////////////////////////////////////////////
+
+  /////////////// plot ////////////////////////////////////////////////
+  FILE *gp = popen("gnuplot","w");
+
+  if (header.density == 0)
+  {
+    str_gp << "(sin(2*x)**2 + cos(x)**2)/pi w l lw 3 t '$w(x)$',"; //sum of cos and sin
+    str_gp << "(-sin(4*x) +2*sin(2*x) +8*x)/(8*pi) w l lw 3 t '$\\int w(x)$',"; //sum of cos and sin CDF
+  }
+  else
+  {
+    str_gp << "exp(-x**2)/sqrt(pi) w l lw 3 t '$w(x)$',"; //gaussian
+    str_gp << "(erf(x)-erf("<<x1<<"))/("<<2*norm<<") lw 2 t '$\\int w(x)$',"; //gaussian CDF
+  }
+  str_gp << "'-' w boxes lw 3 t 'histogram',";
+  str_gp << "'-' w steps lw 3 t 'cdf'\n";
+
+  fprintf(gp, "%s", str_gp.str().c_str());//this sends all commands
+
+  //this sends the points for command '-'
+  for (int k = 0; k < histogram.size(); ++k)
+    fprintf(gp, "%f %f\n", deltaM*k+x1, histogram[k]/(totalPoints*deltaM));
+  fprintf(gp, "%f %f\n", x2, histogram[M-1]/(totalPoints*deltaM));
+  fprintf(gp, "e\n");
+
+  for (int k = 0; k < CDF.size(); ++k)
+    fprintf(gp, "%f %f\n", deltaM*k+x1, CDF[k]);
+  fprintf(gp, "e\n");
+
+  pclose(gp);
+  //////////////////////////////////////////////////////////////////
+
+  for (int f = 0; f < stores.size(); ++f)
+    delete stores[f];
+
+  //////////// tex2pdf and output cleanup ////////////////////////////
+  std::string str_sys = "";
+  str_sys += "latex -interaction batchmode thisWillBeErased.tex\n";
+  str_sys += "dvipdf thisWillBeErased.dvi output.pdf\n";
+  str_sys += "rm -f thisWillBeErased*\n";
+  system(str_sys.c_str());
+  ///////////////////////////////////////////////////////////////////
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include <cmath>
 #include <array>
 #include <sstream>
+#include "xoshiro.h"
 
 inline double w(double x)
 {
@@ -20,8 +21,7 @@ inline double wPrime(float x)
 int main()
 {
   std::random_device rd;
-  std::mt19937 rng(rd());
-  std::uniform_real_distribution<> uniform(0.0, 1.);
+  uniforms uniform(rd());
 
   const int M = 1000; //partition size within region of integration.
   const double x2 = M_PI; //upper bound.
@@ -33,7 +33,7 @@ int main()
   const double deltaX = deltaM/M;
   for (double x_i = x1; x_i <= x2; x_i += deltaX)
   {
-    if(uniform(rng) < w(x_i)/wPrime(x_i))
+    if(uniform() < w(x_i)/wPrime(x_i))
       X.push_back(x_i);
   }
 
@@ -0,0 +1,158 @@
+#ifndef SAMPLESTORE_H
+#define SAMPLESTORE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Binary sample file, written and read through a memory mapping:
+//   sampleHeader, then for every chain a chainHeader followed by its
+//   count samples as doubles.
+// Samples can be re-binned or re-analysed later without sampling again.
+
+typedef struct sampleHeader
+{
+  char magic[8]; // "CPSAMPLE"
+  uint32_t version, density; // density: id chosen by the sampling program
+  uint64_t seed;
+  double x1, x2; // sampled range
+} sampleHeader;
+
+typedef struct chainHeader
+{
+  uint64_t walker, steps, count; // count: samples that follow
+} chainHeader;
+
+// Appends chains to a new file, growing the mapping as needed.
+class sampleSink
+{
+public:
+  sampleSink(const char *path, uint32_t density, uint64_t seed, double x1, double x2)
+    : data(NULL), used(0), capacity(0)
+  {
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+      perror(path);
+      exit(1);
+    }
+    sampleHeader h = {{'C','P','S','A','M','P','L','E'}, 1, density, seed, x1, x2};
+    put(&h, sizeof h);
+  }
+
+  void append(uint64_t walker, uint64_t steps, const double *x, uint64_t count)
+  {
+    chainHeader c = {walker, steps, count};
+    put(&c, sizeof c);
+    put(x, count*sizeof(double));
+  }
+
+  ~sampleSink()
+  {
+    if (data)
+      munmap(data, capacity);
+    if (ftruncate(fd, used) != 0)
+      perror("sampleSink");
+    close(fd);
+  }
+
+private:
+  int fd;
+  char *data;
+  size_t used, capacity;
+  sampleSink(const sampleSink &);
+  sampleSink &operator=(const sampleSink &);
+
+  void put(const void *bytes, size_t n)
+  {
+    if (used + n > capacity)
+    {
+      if (data)
+        munmap(data, capacity);
+      capacity = std::max(2*capacity, used + n + (1 << 20));
+      if (ftruncate(fd, capacity) != 0)
+      {
+        perror("sampleSink");
+        exit(1);
+      }
+      data = (char *) mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (data == MAP_FAILED)
+      {
+        perror("sampleSink");
+        exit(1);
+      }
+    }
+    memcpy(data + used, bytes, n);
+    used += n;
+  }
+};
+
+// Read-only view of a sample file; chains point straight into the mapping.
+class sampleStore
+{
+public:
+  typedef struct chain
+  {
+    uint64_t walker, steps, count;
+    const double *x;
+  } chain;
+
+  sampleHeader header;
+  std::vector<chain> chains;
+
+  sampleStore(const char *path)
+  {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+      perror(path);
+      exit(1);
+    }
+    size = st.st_size;
+    data = (const char *) mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED || size < sizeof header)
+    {
+      fprintf(stderr, "%s: not a sample file\n", path);
+      exit(1);
+    }
+    memcpy(&header, data, sizeof header);
+    if (memcmp(header.magic, "CPSAMPLE", 8) != 0 || header.version != 1)
+    {
+      fprintf(stderr, "%s: not a sample file\n", path);
+      exit(1);
+    }
+    for (size_t at = sizeof header; at + sizeof(chainHeader) <= size; )
+    {
+      chainHeader c;
+      memcpy(&c, data + at, sizeof c);
+      at += sizeof c;
+      if (c.count > (size - at)/sizeof(double))
+        break; // truncated file, keep the complete chains
+      chain k = {c.walker, c.steps, c.count, (const double *) (data + at)};
+      chains.push_back(k);
+      at += c.count*sizeof(double);
+    }
+  }
+
+  ~sampleStore()
+  {
+    munmap((void *) data, size);
+  }
+
+private:
+  const char *data;
+  size_t size;
+  sampleStore(const sampleStore &);
+  sampleStore &operator=(const sampleStore &);
+};
+
+#endif
@@ -2,17 +2,20 @@
 #include <array>
 #include <vector>
 #include <sstream>
+#include "potentials.h"
 
 
-typedef double function(double x, void *params);
+typedef void function(const double *x, double *k, int N, void *params);
 
 
 // dimensionless quantum harmonic oscillator
 // Y'' - (k^2)Y = 0
-double qho(double x, void *params)
+void qho_k(const double *x, double *k, int N, void *params)
 {
   double energy = *(double *) params;
-  return 2*energy - x*x;
+  qho(x, k, N);
+  for (int n = 0; n < N; ++n)
+    k[n] = 2*(energy - k[n]);
 }
 
 typedef struct numerov_params
@@ -27,22 +30,22 @@ void numerov(function f, void *params)
   double *psi = p->psi;
   double *e = &(p->energy);
   double *k = new double[N]();
+  double *x = new double[N];
 
   double h = p->h;
 
-  double x_n = p->x_0;
-  k[0] = f(x_n,e);
-  k[1] = f(x_n + h,e);
-  x_n += 2*h;
+  for (int n = 0; n < N; ++n)
+    x[n] = p->x_0 + n*h;
+  f(x,k,N,e);
   double aux = 1./12 * h*h;
-  for (int n = 2; n < N; ++n, x_n+=h)
+  for (int n = 2; n < N; ++n)
   {
-    k[n] = f(x_n,e);
     double a = 2.*(1. - 5 * aux * k[n-1])*psi[n-1];
     double b = (1. + aux * k[n-2])*psi[n-2];
     double c = 1. + aux * k[n];
     psi[n] = (a - b)/c;
   }
+  delete[] x;
   delete[] k;
 }
 
@@ -53,7 +56,7 @@ int main()
   double psi[N] = {0};
 
   // This finds allowed energies for the QHO
-  numerov_params p = {.psi = psi, .N = N};
+  numerov_params p = {.N = N, .psi = psi};
   for (double e = 0.; e < 400; e+=.125)
   {
     x_i = -sqrt(2*e)-1;
@@ -63,7 +66,7 @@ int main()
     p.h = h;
     p.x_0 = x_i;
     p.energy = e;
-    numerov(qho,&p);
+    numerov(qho_k,&p);
     if (fabs(psi[N-1]) < 1)
       printf("%f\n", e);
   }
@@ -89,7 +92,7 @@ int main()
     p.h = h;
     p.psi[1] = h;
     p.x_0 = x_i;
-    numerov(qho,&p);
+    numerov(qho_k,&p);
     for (int n = 0; n < N; ++n,x_i+=h)
       fprintf(gp, "%f %f\n", x_i, psi[n] + p.energy);
     fprintf(gp, "\n\n");
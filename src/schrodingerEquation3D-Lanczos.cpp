@@ -0,0 +1,560 @@
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <sstream>
+#include "xoshiro.h"
+
+
+typedef double potential(double x, double y, double z);
+
+
+// dimensionless anisotropic harmonic oscillator
+// H = -1/2 laplacian + V
+const double OMEGA[3] = {1., 1.5, 2.};
+double anisotropic(double x, double y, double z)
+{
+  return .5*(OMEGA[0]*OMEGA[0]*x*x + OMEGA[1]*OMEGA[1]*y*y + OMEGA[2]*OMEGA[2]*z*z);
+}
+
+// diatomic in a trap: morse bond along x, harmonic confinement in y and z.
+// double diatomic(double x, double y, double z)
+// {
+//   double f = 1 - exp(-x/1.5);
+//   return 10*(f*f - 1) + .5*(OMEGA[1]*OMEGA[1]*y*y + OMEGA[2]*OMEGA[2]*z*z);
+// }
+
+// Uniform grid of interior points; psi = 0 on the (excluded) boundary.
+// n[2] = 1 gives a 2-D problem, the z-terms of the stencil then drop out.
+typedef struct grid
+{
+  int n[3];
+  double x0[3], h[3];
+  size_t size() const { return (size_t) n[0]*n[1]*n[2]; }
+} grid;
+
+
+// Splits [0,N) into contiguous chunks, one per hardware thread.
+template <class F>
+void parallel_for(size_t N, F f)
+{
+  size_t T = std::max(1u, std::thread::hardware_concurrency());
+  T = std::min(T, N);
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < T; ++t)
+    threads.push_back(std::thread(f, N*t/T, N*(t+1)/T));
+  f(0, N/T);
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+}
+
+double dot(const std::vector<double> &a, const std::vector<double> &b)
+{
+  size_t T = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<double> partial(T, 0.);
+  parallel_for(T, [&](size_t t_lo, size_t t_hi)
+  {
+    for (size_t t = t_lo; t < t_hi; ++t)
+    {
+      double s = 0.;
+      for (size_t i = a.size()*t/T; i < a.size()*(t+1)/T; ++i)
+        s += a[i]*b[i];
+      partial[t] = s;
+    }
+  });
+  double s = 0.;
+  for (size_t t = 0; t < T; ++t) // fixed order, so results are reproducible.
+    s += partial[t];
+  return s;
+}
+
+// y = a*x + y
+void axpy(double a, const std::vector<double> &x, std::vector<double> &y)
+{
+  parallel_for(y.size(), [&](size_t lo, size_t hi)
+  {
+    for (size_t i = lo; i < hi; ++i)
+      y[i] += a*x[i];
+  });
+}
+
+void scale(double a, std::vector<double> &x)
+{
+  parallel_for(x.size(), [&](size_t lo, size_t hi)
+  {
+    for (size_t i = lo; i < hi; ++i)
+      x[i] *= a;
+  });
+}
+
+// Matrix-free H*psi with the 7-point (5-point in 2-D) finite difference stencil.
+// Threads own slabs of z-planes (y-rows in 2-D); within a slab the y-range is
+// tiled so the neighbouring rows of consecutive planes stay in cache.
+const int BLOCK_Y = 16;
+void hamiltonian(const grid &g, const std::vector<double> &V,
+    const std::vector<double> &psi, std::vector<double> &Hpsi)
+{
+  const int nx = g.n[0], ny = g.n[1], nz = g.n[2];
+  const double cx = .5/(g.h[0]*g.h[0]);
+  const double cy = .5/(g.h[1]*g.h[1]);
+  const double cz = nz > 1 ? .5/(g.h[2]*g.h[2]) : 0.;
+  const double diag = 2*(cx + cy + cz);
+  const std::vector<double> zeros(nx, 0.);
+
+  auto rows = [&](int z_lo, int z_hi, int y_lo, int y_hi)
+  {
+    for (int yb = y_lo; yb < y_hi; yb += BLOCK_Y)
+    for (int z = z_lo; z < z_hi; ++z)
+    for (int y = yb; y < std::min(yb + BLOCK_Y, y_hi); ++y)
+    {
+      size_t row = ((size_t) z*ny + y)*nx;
+      const double *c = &psi[row];
+      const double *ym = y > 0 ? c - nx : zeros.data();
+      const double *yp = y < ny-1 ? c + nx : zeros.data();
+      const double *zm = z > 0 ? c - (size_t) nx*ny : zeros.data();
+      const double *zp = z < nz-1 ? c + (size_t) nx*ny : zeros.data();
+      const double *v = &V[row];
+      double *out = &Hpsi[row];
+      if (nx == 1) // no x-neighbours, both are on the boundary
+      {
+        out[0] = (diag + v[0])*c[0] - cy*(ym[0] + yp[0]) - cz*(zm[0] + zp[0]);
+        continue;
+      }
+      out[0] = (diag + v[0])*c[0] - cx*c[1]
+        - cy*(ym[0] + yp[0]) - cz*(zm[0] + zp[0]);
+      for (int i = 1; i < nx-1; ++i)
+        out[i] = (diag + v[i])*c[i] - cx*(c[i-1] + c[i+1])
+          - cy*(ym[i] + yp[i]) - cz*(zm[i] + zp[i]);
+      out[nx-1] = (diag + v[nx-1])*c[nx-1] - cx*c[nx-2]
+        - cy*(ym[nx-1] + yp[nx-1]) - cz*(zm[nx-1] + zp[nx-1]);
+    }
+  };
+  if (nz > 1)
+    parallel_for(nz, [&](size_t lo, size_t hi){ rows(lo, hi, 0, ny); });
+  else
+    parallel_for(ny, [&](size_t lo, size_t hi){ rows(0, 1, lo, hi); });
+}
+
+typedef std::vector<std::vector<double> > block;
+
+// Points per cache block of the block kernels below: every vector of a
+// block is read once while the pieces they are combined with stay in cache.
+const size_t CHUNK = 1024;
+
+// a.b over n points with four partial sums, which the compiler can keep in
+// vector registers; the order is fixed, so results stay reproducible.
+inline double dotChunk(const double *a, const double *b, size_t n)
+{
+  double s0 = 0., s1 = 0., s2 = 0., s3 = 0.;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    s0 += a[i]*b[i];
+    s1 += a[i+1]*b[i+1];
+    s2 += a[i+2]*b[i+2];
+    s3 += a[i+3]*b[i+3];
+  }
+  for (; i < n; ++i)
+    s0 += a[i]*b[i];
+  return (s0 + s1) + (s2 + s3);
+}
+
+// c[j] = v[idx[j]].u for j < n.
+void project(const block &v, const std::vector<int> &idx, int n,
+    const std::vector<double> &u, double *c)
+{
+  size_t T = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<double> partial(T*n, 0.);
+  parallel_for(T, [&](size_t t_lo, size_t t_hi)
+  {
+    for (size_t t = t_lo; t < t_hi; ++t)
+    for (size_t lo = u.size()*t/T; lo < u.size()*(t+1)/T; lo += CHUNK)
+    {
+      size_t hi = std::min(lo + CHUNK, u.size()*(t+1)/T);
+      for (int j = 0; j < n; ++j)
+        partial[t*n + j] += dotChunk(&v[idx[j]][lo], &u[lo], hi - lo);
+    }
+  });
+  for (int j = 0; j < n; ++j)
+  {
+    c[j] = 0.;
+    for (size_t t = 0; t < T; ++t) // fixed order, so results are reproducible.
+      c[j] += partial[t*n + j];
+  }
+}
+
+// u -= sum_j c[j] v[idx[j]], j < n.
+void subtract(const block &v, const std::vector<int> &idx, int n,
+    const double *c, std::vector<double> &u)
+{
+  parallel_for(u.size(), [&](size_t lo0, size_t hi0)
+  {
+    for (size_t lo = lo0; lo < hi0; lo += CHUNK)
+    {
+      size_t hi = std::min(lo + CHUNK, hi0);
+      for (int j = 0; j < n; ++j)
+      {
+        const double *a = v[idx[j]].data();
+        for (size_t i = lo; i < hi; ++i)
+          u[i] -= c[j]*a[i];
+      }
+    }
+  });
+}
+
+// G[i*n+j] = v[idx[i]].w[idx[j]] for i <= j < n, mirrored below the diagonal.
+void gram(const block &v, const block &w, const std::vector<int> &idx, double *G)
+{
+  const int n = idx.size();
+  const size_t N = v[idx[0]].size();
+  size_t T = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<double> partial(T*n*n, 0.);
+  parallel_for(T, [&](size_t t_lo, size_t t_hi)
+  {
+    for (size_t t = t_lo; t < t_hi; ++t)
+    for (size_t lo = N*t/T; lo < N*(t+1)/T; lo += CHUNK)
+    {
+      size_t hi = std::min(lo + CHUNK, N*(t+1)/T);
+      for (int i = 0; i < n; ++i)
+      for (int j = i; j < n; ++j)
+        partial[(t*n + i)*n + j] += dotChunk(&v[idx[i]][lo], &w[idx[j]][lo], hi - lo);
+    }
+  });
+  for (int i = 0; i < n; ++i)
+  for (int j = i; j < n; ++j)
+  {
+    double s = 0.;
+    for (size_t t = 0; t < T; ++t)
+      s += partial[(t*n + i)*n + j];
+    G[i*n+j] = G[j*n+i] = s;
+  }
+}
+
+// Orthonormalizes v[idx[j]], j >= done, against the vectors before it:
+// classical Gram-Schmidt applied twice. Vectors left with less than 1e-10
+// of their norm already lie in the span and are dropped from idx.
+void orthonormalize(block &v, std::vector<int> &idx, int done)
+{
+  std::vector<double> c(idx.size());
+  for (int j = done; j < idx.size(); )
+  {
+    std::vector<double> &u = v[idx[j]];
+    double norm0 = sqrt(dot(u, u));
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      project(v, idx, j, u, c.data());
+      subtract(v, idx, j, c.data(), u);
+    }
+    double norm = sqrt(dot(u, u));
+    if (norm <= 1e-10*norm0)
+    {
+      idx.erase(idx.begin() + j);
+      continue;
+    }
+    scale(1./norm, u);
+    ++j;
+  }
+}
+
+// cyclic Jacobi on the symmetric k x k matrix A (destroyed).
+// On return d holds the eigenvalues in ascending order and the columns of
+// z (k x k) the eigenvectors.
+void jacobi(std::vector<double> &A, int k, std::vector<double> &d, std::vector<double> &z)
+{
+  z.assign(k*k, 0.);
+  for (int i = 0; i < k; ++i)
+    z[i*k+i] = 1.;
+  for (int sweep = 0; sweep < 50; ++sweep)
+  {
+    double off = 0., diag = 0.;
+    for (int p = 0; p < k; ++p)
+    {
+      diag += A[p*k+p]*A[p*k+p];
+      for (int q = p+1; q < k; ++q)
+        off += A[p*k+q]*A[p*k+q];
+    }
+    if (off <= DBL_EPSILON*DBL_EPSILON*diag)
+      break;
+    for (int p = 0; p < k; ++p)
+    for (int q = p+1; q < k; ++q)
+    {
+      if (A[p*k+q] == 0.)
+        continue;
+      double theta = (A[q*k+q] - A[p*k+p])/(2*A[p*k+q]);
+      double t = copysign(1., theta)/(fabs(theta) + hypot(theta, 1.));
+      double c = 1/hypot(t, 1.), s = t*c;
+      for (int r = 0; r < k; ++r) // A <- A J
+      {
+        double ap = A[r*k+p], aq = A[r*k+q];
+        A[r*k+p] = c*ap - s*aq;
+        A[r*k+q] = s*ap + c*aq;
+      }
+      for (int r = 0; r < k; ++r) // A <- J^T A
+      {
+        double ap = A[p*k+r], aq = A[q*k+r];
+        A[p*k+r] = c*ap - s*aq;
+        A[q*k+r] = s*ap + c*aq;
+      }
+      for (int r = 0; r < k; ++r)
+      {
+        double zp = z[r*k+p], zq = z[r*k+q];
+        z[r*k+p] = c*zp - s*zq;
+        z[r*k+q] = s*zp + c*zq;
+      }
+    }
+  }
+  // sort eigenpairs, ascending.
+  std::vector<int> order(k);
+  for (int i = 0; i < k; ++i)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&](int a, int b){ return A[a*k+a] < A[b*k+b]; });
+  std::vector<double> zs(k*k);
+  d.resize(k);
+  for (int j = 0; j < k; ++j)
+  {
+    d[j] = A[order[j]*k + order[j]];
+    for (int r = 0; r < k; ++r)
+      zs[r*k+j] = z[r*k + order[j]];
+  }
+  z.swap(zs);
+}
+
+// Preconditioner: m steps of Chebyshev iteration for H x = r from x = 0,
+// with the spectrum of H taken as [alpha, beta]; r is replaced by x = p(H) r.
+// p > 0 on (0, beta] for any 0 < alpha < beta, so p(H) is positive definite
+// and approximates 1/H ever better on [alpha, beta] as m grows. tmp holds
+// three work vectors.
+void chebyshev(const grid &g, const std::vector<double> &V, double alpha,
+    double beta, int m, std::vector<double> &r, block &tmp)
+{
+  const double theta = .5*(beta + alpha), delta = .5*(beta - alpha);
+  const double sigma = theta/delta;
+  std::vector<double> &x = tmp[0], &d = tmp[1], &Ad = tmp[2];
+  d = r;
+  scale(1./theta, d);
+  std::fill(x.begin(), x.end(), 0.);
+  double rho = 1./sigma;
+  for (int k = 0; k < m; ++k)
+  {
+    axpy(1., d, x);
+    if (k == m-1)
+      break;
+    hamiltonian(g, V, d, Ad);
+    axpy(-1., Ad, r);
+    double rho_next = 1./(2*sigma - rho);
+    scale(rho_next*rho, d);
+    axpy(2*rho_next/delta, r, d);
+    rho = rho_next;
+  }
+  r.swap(x);
+}
+
+typedef struct lobpcg_params
+{
+  int guard, max_iter; // extra block vectors, they speed up the last wanted ones
+  int degree; // chebyshev steps preconditioning each residual
+  double tol;
+} lobpcg_params;
+// Lowest nev eigenpairs of H by LOBPCG, the locally optimal block
+// conjugate gradient: every iteration does Rayleigh-Ritz on the block X,
+// its residuals W and the previous directions P, all kept orthonormal.
+// Pairs whose residual |H x - theta x| drops below tol stop adding
+// residuals. Storage is 6 b vectors of the grid, b = nev + guard: the
+// basis and H times it.
+// psi holds a (random) starting block on entry, the eigenvectors on return;
+// theta and residual have the Ritz values, ascending, and their residuals.
+int lobpcg(const grid &g, const std::vector<double> &V, int nev, block &psi,
+    std::vector<double> &theta, std::vector<double> &residual, lobpcg_params p)
+{
+  const size_t N = g.size();
+  const int b = nev + p.guard;
+  // slots [0,b) X, [b,2b) W, [2b,3b) P, and H times each in HS.
+  block S(3*b, std::vector<double>(N)), HS(3*b, std::vector<double>(N));
+  block tmp(3, std::vector<double>(N));
+  // gershgorin bound of the spectrum: 4(cx + cy + cz) + max V.
+  double beta = *std::max_element(V.begin(), V.end());
+  for (int a = 0; a < 3; ++a)
+    if (g.n[a] > 1)
+      beta += 2./(g.h[a]*g.h[a]);
+  std::vector<double> G, C, d;
+  std::vector<int> X(b);
+  for (int c = 0; c < b; ++c)
+  {
+    S[c] = psi[c];
+    X[c] = c;
+  }
+
+  theta.assign(b, 0.);
+  residual.assign(b, INFINITY);
+  int nP = 0, iter;
+  for (iter = 0; iter < p.max_iter; ++iter)
+  {
+    std::vector<int> idx(X);
+    orthonormalize(S, idx, 0);
+    if (idx.size() < b)
+      return -1;
+
+    // Ritz values and residuals of the block.
+    int converged = 0;
+    for (int c = 0; c < b; ++c)
+    {
+      hamiltonian(g, V, S[c], HS[c]);
+      theta[c] = dot(S[c], HS[c]);
+      std::vector<double> &w = S[b+c];
+      w = HS[c];
+      axpy(-theta[c], S[c], w);
+      residual[c] = sqrt(dot(w, w));
+      if (c < nev && residual[c] < p.tol)
+        ++converged;
+      if (residual[c] >= p.tol)
+        idx.push_back(b+c);
+    }
+    if (converged == nev)
+      break;
+    for (int j = b; j < idx.size(); ++j)
+      chebyshev(g, V, theta[0], beta, p.degree, S[idx[j]], tmp);
+    for (int c = 0; c < nP; ++c)
+      idx.push_back(2*b+c);
+    orthonormalize(S, idx, b);
+
+    // Rayleigh-Ritz on the basis S[idx].
+    const int k = idx.size();
+    for (int j = b; j < k; ++j)
+      hamiltonian(g, V, S[idx[j]], HS[idx[j]]);
+    G.resize(k*k);
+    gram(S, HS, idx, G.data());
+    jacobi(G, k, d, C);
+
+    // new X = S C and new P = the W and P part of it, for the lowest b
+    // Ritz vectors; computed point by point, so in place.
+    nP = b;
+    parallel_for(N, [&](size_t lo, size_t hi)
+    {
+      std::vector<double> a(k);
+      for (size_t i = lo; i < hi; ++i)
+      {
+        for (int j = 0; j < k; ++j)
+          a[j] = S[idx[j]][i];
+        for (int c = 0; c < b; ++c)
+        {
+          double x = 0., q = 0.;
+          for (int j = 0; j < b; ++j)
+            x += a[j]*C[j*k+c];
+          for (int j = b; j < k; ++j)
+            q += a[j]*C[j*k+c];
+          S[c][i] = x + q;
+          S[2*b+c][i] = q;
+        }
+      }
+    });
+  }
+  for (int c = 0; c < nev; ++c)
+    psi[c] = S[c];
+  theta.resize(nev);
+  residual.resize(nev);
+  return iter;
+}
+
+// usage: schrodingerEquation3D-Lanczos [n [dimensions]]
+// n points per axis (64), dimensions 3 or 2.
+int main(int argc, char **argv)
+{
+  // 64^3 takes ~10 s on one core; ~215^3 (10^7 points) needs 6(nev+guard) = 48
+  // vectors, about 3.8 gigabytes.
+  const int n = argc > 1 ? atoi(argv[1]) : 64;
+  const int dimensions = argc > 2 ? atoi(argv[2]) : 3;
+  const int nev = 6; // number of eigenpairs
+  grid g;
+  for (int a = 0; a < 3; ++a)
+  {
+    g.n[a] = n;
+    double L = 6./sqrt(OMEGA[a]);
+    g.h[a] = 2*L/(n+1);
+    g.x0[a] = -L + g.h[a];
+  }
+  if (dimensions == 2)
+  {
+    g.n[2] = 1; g.x0[2] = 0; // 2-D problem
+  }
+
+  potential *U = anisotropic;
+  std::vector<double> V(g.size());
+  for (int z = 0; z < g.n[2]; ++z)
+  for (int y = 0; y < g.n[1]; ++y)
+  for (int x = 0; x < g.n[0]; ++x)
+    V[((size_t) z*g.n[1] + y)*g.n[0] + x] =
+      U(g.x0[0] + x*g.h[0], g.x0[1] + y*g.h[1], g.x0[2] + z*g.h[2]);
+
+  // exact eigenvalues of the oscillator, for comparison.
+  std::vector<double> exact;
+  for (int i = 0; i < nev; ++i)
+  for (int j = 0; j < nev; ++j)
+  for (int k = 0; k < (g.n[2] > 1 ? nev : 1); ++k)
+    exact.push_back((i+.5)*OMEGA[0] + (j+.5)*OMEGA[1]
+        + (g.n[2] > 1 ? (k+.5)*OMEGA[2] : 0.));
+  std::sort(exact.begin(), exact.end());
+
+  // random start, it overlaps every state whatever its symmetry.
+  lobpcg_params p = {.guard = 2, .max_iter = 5000, .degree = 12, .tol = 1e-6};
+  uniforms uniform(1);
+  block psi(nev + p.guard, std::vector<double>(g.size()));
+  for (int c = 0; c < psi.size(); ++c)
+    for (size_t j = 0; j < g.size(); ++j)
+      psi[c][j] = uniform() - .5;
+  std::vector<double> energy, residual;
+  int iterations = lobpcg(g, V, nev, psi, energy, residual, p);
+  if (iterations < 0)
+  {
+    fprintf(stderr, "error: start block is linearly dependent\n");
+    return 1;
+  }
+  for (int i = 0; i < nev; ++i)
+  {
+    printf("%i %f %f %.1e\n", i, energy[i], exact[i], residual[i]);
+    if (residual[i] >= p.tol)
+      fprintf(stderr, "warning: eigenvalue %i not converged after %i iterations"
+          " (residual %.1e, tol %.1e)\n", i, iterations, residual[i], p.tol);
+    if (i > 0 && energy[i] < energy[i-1])
+    {
+      fprintf(stderr, "error: eigenvalues out of order, %f after %f\n",
+          energy[i], energy[i-1]);
+      return 1;
+    }
+  }
+  printf("%i iterations\n", iterations);
+
+  // plots psi_n(x,0,0) shifted by its energy, as in the 1-D program.
+  std::ostringstream gpcmd;
+  gpcmd << "set terminal epslatex standalone\n";
+  gpcmd << "set output 'thisWillBeErased.tex'\n";
+  gpcmd << "set colorsequence podo\n";
+  gpcmd << "set border lw 3\n";
+  gpcmd << "set sample 300\n";
+  gpcmd << "set key top left\n";
+  gpcmd << "plot ";
+  gpcmd << ".5 * " << OMEGA[0]*OMEGA[0] << "* x**2 w l lw 3 t '$V(x,0,0)$',";
+  gpcmd << "'-' w l lw 3 t '$\\psi_n(x,0,0)$'\n";
+  FILE *gp = popen("gnuplot","w");
+  fprintf(gp, "%s",gpcmd.str().c_str());//this sends all previous commands
+  const size_t centre = ((size_t) (g.n[2]/2)*g.n[1] + g.n[1]/2)*g.n[0];
+  for (int i = 0; i < nev; ++i)
+  {
+    double amplitude = 0.;
+    for (int x = 0; x < g.n[0]; ++x)
+      amplitude = std::max(amplitude, fabs(psi[i][centre + x]));
+    for (int x = 0; x < g.n[0]; ++x)
+      fprintf(gp, "%f %f\n", g.x0[0] + x*g.h[0],
+          .4*psi[i][centre + x]/(amplitude + DBL_MIN) + energy[i]);
+    fprintf(gp, "\n\n");
+  }
+  fprintf(gp, "e\n");
+  pclose(gp);
+
+  std::string str_sys = "";
+  str_sys += "latex -interaction batchmode thisWillBeErased.tex\n";
+  str_sys += "dvipdf thisWillBeErased.dvi output.pdf\n";
+  str_sys += "rm -f thisWillBeErased*\n";
+  system(str_sys.c_str());
+  return 0;
+}
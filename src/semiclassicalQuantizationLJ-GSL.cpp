@@ -2,11 +2,12 @@
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_integration.h>
 #include <gsl/gsl_roots.h>
+#include "potentials.h"
 
 inline double integrand_LJ (double x, void *params)
 {
   double energy = *(double *) params;
-  return sqrt(energy - 4*(gsl_pow_int(x,-12)-gsl_pow_int(x,-6)));
+  return sqrt(energy - lennardJones(x));
 }
 typedef struct action_params
 {
@@ -1,59 +1,71 @@
 #include <iostream>
 #include <cmath>
+#include "potentials.h"
+#include "quantization.h"
 
 // H_2 molecule
 const double GAMMA = 21.7;
 const double V0 = 4.747; // eV
 
-inline double v(double x)
-{
-  // Lennard-Jones potential.
-  return 4*(pow(x,-12)-pow(x,-6));
-}
-double action(double e)
+int evaluations = 0; // calls of action(), reported per level
+
+// action s(e) and its derivative ds/de = GAMMA/2 int dx/sqrt(e - v),
+// the classical period, from the same nodes.
+double action(double e, double &ds)
 {
+  ++evaluations;
   // get turning points analytically for lennard-jones.
   double x_in = sqrt(cbrt( 2/e * (+sqrt(1+e)-1) ));
   double x_out = sqrt(cbrt( 2/e * (-sqrt(1+e)-1) ));
 
-  int N = 8192;
+  const int N = 8192;
   double h = (x_out-x_in)/N;
+  // sqrt(e - v) at the inner nodes x_in + j*h, j = 1..N-1, in one batch.
+  static double x[N], p[N];
+  for (int j = 1; j < N; ++j)
+    x[j] = x_in + j*h;
+  lennardJonesMomentum(e, x+1, p+1, N-1);
   // integrate using bode's rule
   double y_h = 0; // e - v(x_in) = 0
+  double t_h = 0;
   for (int j = 1; j < N; j+=2)
-    y_h += 32*sqrt(e - v(x_in + j*h));
+  {
+    y_h += 32*p[j];
+    t_h += 32/p[j];
+  }
   for (int j = 2; j < N; j+=4)
-    y_h += 12*sqrt(e - v(x_in + j*h));
+  {
+    y_h += 12*p[j];
+    t_h += 12/p[j];
+  }
   for (int j = 4; j < N; j+=4)
-    y_h += 14*sqrt(e - v(x_in + j*h));
+  {
+    y_h += 14*p[j];
+    t_h += 14/p[j];
+  }
+  static const double c = bodeSingularity(N), c2 = bodeSingularity2(N);
+  double a = fabs(lennardJonesPrime(x_in)), b = fabs(lennardJonesPrime(x_out));
+  double a2 = lennardJonesPrime2(x_in), b2 = lennardJonesPrime2(x_out);
+  ds = GAMMA/2 * (t_h*2*h/45 + c*(sqrt(h/a) + sqrt(h/b))
+      + c2*h*sqrt(h)*(a2/(4*a*sqrt(a)) + b2/(4*b*sqrt(b))));
   return y_h *= GAMMA*2*h/45;
 }
+double action(double e)
+{
+  double ds;
+  return action(e, ds);
+}
 
 // action is equal to de broglie wave number,
-// so define funct and find its roots.
-inline double funct(double e, int n){ return action(e) - (n + .5)*M_PI; }
-double normalized_energy(int n)
+// so the energies are the roots of s(e) - (n + .5)pi.
+// lo and guess come from the levels below when known.
+double normalized_energy(int n, double lo = -1, double guess = NAN, double *ds = 0)
 {
-  const double step = 0.001953125; //2^-9
-  double e1 = -1;
-  double x = funct(e1,n);
-  bool flag = (x>0);
-  for (double e2 = e1+step; e2 < 0; e2+=step)
-  {
-    x = funct(e2,n);
-    if ((x>0) != flag)// function changes sign in [e1,e2]
-    {
-      // secant method.
-      for (int i = 0; i < 10; ++i)
-      {
-        double y = funct(e2,n);
-        e2 += -y*(e2-e1)/(y-funct(e1,n));
-      }
-      return e2;
-    }
-   e1 = e2;
-  }
-  return 1.;
+  // the grid of action() stretches without bound as e -> 0.
+  const double top = -0.001953125; //-2^-9
+  double (*s)(double, double &) = action;
+  double e = quantize(s, (n + .5)*M_PI, lo, top, guess, ds);
+  return std::isnan(e) ? 1. : e;
 }
 
 int main()
@@ -89,14 +101,23 @@ int main()
   // fprintf(gp, "e\n");
   
   // plots quantized energies.
-  for (int n = 0; n < 5; ++n)
-    fprintf(gp, "%i %f\n", n, V0*normalized_energy(n));
-  fprintf(gp, "e\n");
+  // each level starts newton one quantum of action above the last.
+  double energy[5], ds[5];
+  printf("n  E_n        action evaluations\n");
   for (int n = 0; n < 5; ++n)
   {
-    double energy = V0*normalized_energy(n);
-    fprintf(gp, "%i %f %f\n", n, energy-.2, energy);
+    int before = evaluations;
+    double guess = NAN;
+    if (n > 0)
+      guess = nextLevel(energy[n-1], ds[n-1], ds[n > 1 ? n-2 : 0], M_PI);
+    energy[n] = normalized_energy(n, n ? energy[n-1] : -1, guess, &ds[n]);
+    printf("%-2i %f  %i\n", n, V0*energy[n], evaluations - before);
   }
+  for (int n = 0; n < 5; ++n)
+    fprintf(gp, "%i %f\n", n, V0*energy[n]);
+  fprintf(gp, "e\n");
+  for (int n = 0; n < 5; ++n)
+    fprintf(gp, "%i %f %f\n", n, V0*energy[n]-.2, V0*energy[n]);
   fprintf(gp, "e\n");
 
   pclose(gp);
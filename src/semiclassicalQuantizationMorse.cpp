@@ -1,69 +1,93 @@
 #include <iostream>
 #include <cmath>
 #include <sstream>
+#include "potentials.h"
+#include "quantization.h"
 
 // H_2 molecule
 const double GAMMA = 2*21.934562;
 const double V0 = 4.747; // eV
 const double r_min = 0.74166; // Angstroms
-const double E0 = -4.477;
 
-inline double V(double r, double beta)
-{
-  // Morse potential.
-  double f = 1 - exp((r_min-r)/beta);
-  return V0 * ( f*f - 1);
+int evaluations = 0; // calls of action(), reported per level
 
-}
-double action(double E, double beta)
+// action S(E) and its derivative dS/dE = GAMMA int dr/sqrt(E - V),
+// the classical period, from the same nodes.
+double action(double E, double beta, double &dS)
 {
+  ++evaluations;
   // get turning points analytically for lennard-jones.
   double r_in = r_min - beta*log(1+sqrt(E/V0+1));
   double r_out = r_min - beta*log(1-sqrt(E/V0+1));
 
-  int N = 512;
+  const int N = 512;
   double h = (r_out-r_in)/N;
+  // sqrt(E - V) at the inner nodes r_in + j*h, j = 1..N-1, in one batch.
+  static double r[N], p[N];
+  for (int j = 1; j < N; ++j)
+    r[j] = r_in + j*h;
+  morseMomentum(E, r+1, p+1, N-1, beta, r_min, V0);
   // integrate using bode's rule
   double y_h = 0; // E - V(r_in,beta) = 0
+  double t_h = 0;
   for (int j = 1; j < N; j+=2)
-    y_h += 32*sqrt(E - V(r_in + j*h, beta));
+  {
+    y_h += 32*p[j];
+    t_h += 32/p[j];
+  }
   for (int j = 2; j < N; j+=4)
-    y_h += 12*sqrt(E - V(r_in + j*h, beta));
+  {
+    y_h += 12*p[j];
+    t_h += 12/p[j];
+  }
   for (int j = 4; j < N; j+=4)
-    y_h += 14*sqrt(E - V(r_in + j*h, beta));
+  {
+    y_h += 14*p[j];
+    t_h += 14/p[j];
+  }
+  static const double c = bodeSingularity(N), c2 = bodeSingularity2(N);
+  double a = fabs(morsePrime(r_in, beta, r_min, V0));
+  double b = fabs(morsePrime(r_out, beta, r_min, V0));
+  double a2 = morsePrime2(r_in, beta, r_min, V0);
+  double b2 = morsePrime2(r_out, beta, r_min, V0);
+  dS = GAMMA * (t_h*2*h/45 + c*(sqrt(h/a) + sqrt(h/b))
+      + c2*h*sqrt(h)*(a2/(4*a*sqrt(a)) + b2/(4*b*sqrt(b))));
   return y_h *= GAMMA*2*2*h/45;
 }
+double action(double E, double beta)
+{
+  double dS;
+  return action(E, beta, dS);
+}
 
 // action is equal to de broglie wave number,
-// so define funct and find its roots.
-inline double funct(double E, double beta, int n){ return action(E,beta) - (n + .5)*2*M_PI; }
-double energy(double beta, int n)
+// so the energies are the roots of S(E) - (n + .5)2pi.
+// lo and guess come from the levels below when known.
+double energy(double beta, int n, double lo = -V0, double guess = NAN, double *dS = 0)
 {
-  const double step = 0.001953125; //2^-9
-  double E1 = E0;
-  double x = funct(E1,beta,n);
-  bool flag = (x>0);
-  for (double E2 = E1+step; E2 < 0; E2+=step)
-  {
-    x = funct(E2,beta,n);
-    if ((x>0) != flag)// function changes sign in [E1,E2]
-    {
-      // secant method.
-      for (int i = 0; i < 10; ++i)
-      {
-        double y = funct(E2,beta,n);
-        E2 += -y*(E2-E1)/(y-funct(E1,beta,n));
-      }
-      return E2;
-    }
-    E1 = E2;
-  }
-  return -1.;
+  // the outer turning point goes to infinity as E -> 0.
+  const double top = -0.001953125; //-2^-9
+  double E = quantize([beta](double E, double &dS){ return action(E, beta, dS); },
+      (n + .5)*2*M_PI, lo, top, guess, dS);
+  return std::isnan(E) ? -1. : E;
 }
 
 int main()
 {
   const double beta = .181293;
+
+  // quantized energies; each level starts newton one quantum of action
+  // above the last.
+  double E[15], dS[15];
+  printf("n  E_n        action evaluations\n");
+  for (int n = 0; n < 15; ++n)
+  {
+    int before = evaluations;
+    E[n] = n ? energy(beta, n, E[n-1], nextLevel(E[n-1], dS[n-1], dS[n > 1 ? n-2 : 0], 2*M_PI), &dS[n])
+             : energy(beta, n, -V0, NAN, &dS[n]);
+    printf("%-2i %f  %i\n", n, E[n], evaluations - before);
+  }
+
   std::ostringstream str_gp;
   str_gp << "set terminal epslatex standalone\n";
   str_gp << "set output 'thisWillBeErased.tex'\n";
@@ -96,13 +120,10 @@ int main()
   
   // plots quantized energies.
   // for (int n = 0; n < 15; ++n)
-  //   fprintf(gp, "%i %f\n", n, energy(beta,n));
+  //   fprintf(gp, "%i %f\n", n, E[n]);
   // fprintf(gp, "e\n");
   // for (int n = 0; n < 15; ++n)
-  // {
-  //   double E = energy(beta,n);
-  //   fprintf(gp, "%i %f %.3f\n", n, E-.2, E);
-  // }
+  //   fprintf(gp, "%i %f %.3f\n", n, E[n]-.2, E[n]);
   // fprintf(gp, "e\n");
 
   pclose(gp);
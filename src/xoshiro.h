@@ -0,0 +1,153 @@
+#ifndef XOSHIRO_H
+#define XOSHIRO_H
+
+#include <cstdint>
+#include <cstring>
+
+// Eight xoshiro256+ generators side by side, one per vector lane.
+typedef uint64_t xoshiroLanes __attribute__((vector_size(64)));
+typedef double doubleLanes __attribute__((vector_size(64)));
+
+// Uniform doubles in [0,1) from eight interleaved xoshiro256+ generators.
+// The buffer is refilled in bulk, all lanes advancing together as vector
+// operations, and the top 52 bits of each output become a double by
+// setting the exponent of 1.0 and subtracting 1.
+// uniforms(seed, stream) gives independent sequences for distinct streams,
+// e.g. one per walker.
+class uniforms
+{
+public:
+  static const int LANES = 8;
+
+  uniforms(uint64_t seed = 0, uint64_t stream = 0)
+  {
+    seedLanes(seed, stream, s);
+    pos = SIZE;
+  }
+
+  // splitmix64 on (seed, stream, lane), as the xoshiro authors advise.
+  static void seedLanes(uint64_t seed, uint64_t stream, uint64_t s[4][LANES])
+  {
+    for (int l = 0; l < LANES; ++l)
+    {
+      uint64_t z = seed ^ (0x9E3779B97F4A7C15ULL*(stream*LANES + l + 1));
+      for (int k = 0; k < 4; ++k)
+      {
+        z += 0x9E3779B97F4A7C15ULL;
+        uint64_t x = z;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        s[k][l] = x ^ (x >> 31);
+      }
+    }
+  }
+
+  double operator()()
+  {
+    if (pos == SIZE)
+      refill();
+    return buffer[pos++];
+  }
+
+private:
+  static const int SIZE = 512;
+  uint64_t s[4][LANES]; // plain arrays, heap allocation need not align them
+  double buffer[SIZE];
+  int pos;
+
+  void refill()
+  {
+    xoshiroLanes s0, s1, s2, s3;
+    memcpy(&s0, s[0], sizeof s0);
+    memcpy(&s1, s[1], sizeof s1);
+    memcpy(&s2, s[2], sizeof s2);
+    memcpy(&s3, s[3], sizeof s3);
+    for (int i = 0; i < SIZE; i += LANES)
+    {
+      xoshiroLanes result = s0 + s3;
+      xoshiroLanes t = s1 << 17;
+      s2 ^= s0;
+      s3 ^= s1;
+      s1 ^= s2;
+      s0 ^= s3;
+      s2 ^= t;
+      s3 = (s3 << 45) | (s3 >> 19);
+      xoshiroLanes bits = (result >> 12) | 0x3FF0000000000000ULL;
+      doubleLanes d = (doubleLanes) bits - 1.;
+      memcpy(buffer + i, &d, sizeof d);
+    }
+    memcpy(s[0], &s0, sizeof s0);
+    memcpy(s[1], &s1, sizeof s1);
+    memcpy(s[2], &s2, sizeof s2);
+    memcpy(s[3], &s3, sizeof s3);
+    pos = 0;
+  }
+};
+
+// 64-byte vectors are returned by value from inline functions only, so the
+// ABI note GCC gives without AVX-512 does not apply.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+// Sixteen streams side by side, one per vector lane, as float lanes.
+typedef uint64_t streamLanes __attribute__((vector_size(128)));
+typedef uint32_t floatBitLanes __attribute__((vector_size(64)));
+typedef float floatLanes __attribute__((vector_size(64)));
+
+// The sequences of uniforms(seed, first + l), l = 0..15, a lane each: every
+// call gives each lane the next number of its own stream, cut to a float in
+// [0,1). Sixteen walkers draw together as vector operations and still see
+// exactly the numbers uniforms would give them one at a time.
+class uniformLanes
+{
+public:
+  static const int LANES = 16;
+
+  uniformLanes(uint64_t seed = 0, uint64_t first = 0)
+  {
+    for (int l = 0; l < LANES; ++l)
+    {
+      uint64_t t[4][uniforms::LANES];
+      uniforms::seedLanes(seed, first + l, t);
+      for (int g = 0; g < uniforms::LANES; ++g)
+        for (int k = 0; k < 4; ++k)
+          s[g][k][l] = t[k][g];
+    }
+    next = 0;
+  }
+
+  // uniforms hands out its eight generators in turn, so the n-th call
+  // advances generator n % 8 of every stream.
+  floatLanes operator()()
+  {
+    uint64_t (*g)[LANES] = s[next];
+    next = (next + 1) % uniforms::LANES;
+    streamLanes s0, s1, s2, s3;
+    memcpy(&s0, g[0], sizeof s0);
+    memcpy(&s1, g[1], sizeof s1);
+    memcpy(&s2, g[2], sizeof s2);
+    memcpy(&s3, g[3], sizeof s3);
+    streamLanes result = s0 + s3;
+    streamLanes t = s1 << 17;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = (s3 << 45) | (s3 >> 19);
+    memcpy(g[0], &s0, sizeof s0);
+    memcpy(g[1], &s1, sizeof s1);
+    memcpy(g[2], &s2, sizeof s2);
+    memcpy(g[3], &s3, sizeof s3);
+    floatBitLanes bits = __builtin_convertvector(result >> 41, floatBitLanes) | 0x3F800000;
+    return (floatLanes) bits - 1.f;
+  }
+
+private:
+  uint64_t s[uniforms::LANES][4][LANES];
+  int next;
+};
+
+#pragma GCC diagnostic pop
+
+#endif